@@ -72,7 +72,7 @@
 #elif TIM_NUM == 8
 #define TIM_HANDLE  htim8
 #else
-#error Wrong timer! Fix it in ARGB.h string 41
+#error Wrong timer! Fix TIM_NUM in ARGB.h
 #warning If you shure, set TIM_HANDLE and APB ring by yourself
 #endif
 
@@ -83,6 +83,41 @@
 #define APB2
 #endif
 
+/// Timer's channel DMA request & destination register
+#if TIM_BURST
+#define NUM_STRIPS 4  ///< CH1..CH4 are driven together
+#define ARGB_TIM_DMA_ID TIM_DMA_ID_UPDATE
+#define ARGB_TIM_DMA_CC TIM_DMA_UPDATE
+#define ARGB_TIM_CCR DMAR  ///< Burst: CCR1..CCR4 on each update
+#elif TIM_CH == TIM_CHANNEL_1
+#define NUM_STRIPS 1
+#define ARGB_TIM_DMA_ID TIM_DMA_ID_CC1
+#define ARGB_TIM_DMA_CC TIM_DMA_CC1
+#define ARGB_TIM_CCR CCR1
+#elif TIM_CH == TIM_CHANNEL_2
+#define NUM_STRIPS 1
+#define ARGB_TIM_DMA_ID TIM_DMA_ID_CC2
+#define ARGB_TIM_DMA_CC TIM_DMA_CC2
+#define ARGB_TIM_CCR CCR2
+#elif TIM_CH == TIM_CHANNEL_3
+#define NUM_STRIPS 1
+#define ARGB_TIM_DMA_ID TIM_DMA_ID_CC3
+#define ARGB_TIM_DMA_CC TIM_DMA_CC3
+#define ARGB_TIM_CCR CCR3
+#elif TIM_CH == TIM_CHANNEL_4
+#define NUM_STRIPS 1
+#define ARGB_TIM_DMA_ID TIM_DMA_ID_CC4
+#define ARGB_TIM_DMA_CC TIM_DMA_CC4
+#define ARGB_TIM_CCR CCR4
+#endif
+
+/// HAL channel state of used channel(s)
+#if TIM_BURST
+#define ARGB_CH_STATE_SET(st) TIM_CHANNEL_STATE_SET_ALL(&TIM_HANDLE, (st))
+#else
+#define ARGB_CH_STATE_SET(st) TIM_CHANNEL_STATE_SET(&TIM_HANDLE, TIM_CH, (st))
+#endif
+
 /// DMA Size
 #if defined(DMA_SIZE_BYTE)
 typedef u8_t dma_siz;
@@ -95,40 +130,121 @@ typedef u32_t dma_siz;
 extern TIM_HandleTypeDef (TIM_HANDLE);  ///< Timer handler
 extern DMA_HandleTypeDef (DMA_HANDLE);  ///< DMA handler
 
-volatile u8_t PWM_HI;    ///< PWM Code HI Log.1 period
-volatile u8_t PWM_LO;    ///< PWM Code LO Log.1 period
+volatile dma_siz PWM_HI;  ///< PWM Code HI Log.1 period
+volatile dma_siz PWM_LO;  ///< PWM Code LO Log.1 period
+volatile u32_t ARR_BIT;  ///< Timer period of one bit
+volatile u32_t ARR_RES;  ///< Timer period stretched for reset
+volatile u16_t RES_PERIODS = 1; ///< Stretched periods in reset
+
+/// Reset (latch) length, us
+#ifndef RESET_US
+#if defined(WS2812B)
+#define RESET_US 280 ///< WS2812B-V5: >280us
+#elif defined(SK6812)
+#define RESET_US 80  ///< SK6812: >80us
+#else
+#define RESET_US 50  ///< WS2811, WS2812: >50us
+#endif
+#endif
+
+/// Default settings from ARGB.h
+static const ARGB_CONFIG ARGB_DEF_CFG = {
+    .pixels = NUM_PIXELS,
+#if defined(SK6812)
+    .order = ARGB_RGBW, .period = 1250, .t1h = 600, .t0h = 300,  // 48% / 24%
+#elif defined(WS2811S)
+    .order = ARGB_RGB, .period = 2500, .t1h = 1200, .t0h = 500,  // 48% / 20%
+#elif defined(WS2811F)
+    .order = ARGB_RGB, .period = 1250, .t1h = 600, .t0h = 250,   // 48% / 20%
+#else
+    .order = ARGB_GRB, .period = 1250, .t1h = 700, .t0h = 350,   // 56% / 28%
+#endif
+    .reset = RESET_US,
+};
+
+/// Subpixel positions in pack for each #ARGB_ORDER: R, G, B, W
+static const u8_t ORDER_POS[][4] = {
+    {0, 1, 2, 3}, // RGB
+    {1, 0, 2, 3}, // GRB
+    {1, 2, 0, 3}, // BRG
+    {0, 1, 2, 3}, // RGBW
+    {1, 0, 2, 3}, // GRBW
+};
 
 #ifdef SK6812
-#define NUM_BYTES (4 * NUM_PIXELS) ///< Strip size in bytes
-#define PWM_BUF_LEN (4 * 8 * 2)    ///< Pack len * 8 bit * 2 LEDs
+#define LED_BYTES_DEF 4 ///< Default pack len
 #else
-#define NUM_BYTES (3 * NUM_PIXELS) ///< Strip size in bytes
-#define PWM_BUF_LEN (3 * 8 * 2)    ///< Pack len * 8 bit * 2 LEDs
+#define LED_BYTES_DEF 3 ///< Default pack len
 #endif
+#define LED_BYTES_MAX 4 ///< Max pack len (RGBW), any layout fits buffers
+#define RGB_BUF_LEN (NUM_STRIPS * LED_BYTES_MAX * NUM_PIXELS) ///< All strips size in bytes
+#define PWM_BUF_LEN (LED_BYTES_MAX * 8 * NUM_STRIPS * 2) ///< Max pack len * 8 bit * strips * 2 LEDs
+#define NUM_LEDS (NUM_STRIPS * ARGB_PIXELS)  ///< LEDs on all strips
 
-/// Static LED buffer
-volatile u8_t RGB_BUF[NUM_BYTES] = {0,};
+volatile u16_t ARGB_PIXELS = NUM_PIXELS;  ///< Pixel quantity per strip
+volatile u8_t LED_BYTES = LED_BYTES_DEF;  ///< Pack len: 3 - RGB, 4 - RGBW
+volatile u16_t PWM_LED_LEN = LED_BYTES_DEF * 8 * NUM_STRIPS; ///< Pack len * 8 bit * strips
+const u8_t *ORD_POS = ORDER_POS[0];       ///< Subpixel positions of current order
+
+/// Static LED buffers: one to draw, one on air. Strips go one after another
+volatile u8_t RGB_MEM[2][RGB_BUF_LEN] = {{0,},};
+volatile u8_t *volatile RGB_BUF = RGB_MEM[0]; ///< LED buffer to draw
+volatile u8_t *volatile RGB_TX = RGB_MEM[1];  ///< LED buffer on air
 
 /// Timer PWM value buffer
 volatile dma_siz PWM_BUF[PWM_BUF_LEN] = {0,};
 /// PWM buffer iterator
 volatile u16_t BUF_COUNTER = 0;
+/// Zero pulses, streamed to timer while reset
+volatile dma_siz PWM_ZERO[NUM_STRIPS] = {0,};
 
 volatile u8_t ARGB_BR = 255;     ///< LED Global brightness
 volatile ARGB_STATE ARGB_LOC_ST; ///< Buffer send status
+volatile bool ARGB_NEXT = false; ///< Next frame is queued
 
 static inline u8_t scale8(u8_t x, u8_t scale); // Gamma correction
 static void HSV2RGB(u8_t hue, u8_t sat, u8_t val, u8_t *_r, u8_t *_g, u8_t *_b);
+static inline void PWM_FillPack(volatile dma_siz *dst, u16_t led, const u8_t bytes);
+static void PWM_FillRGB(volatile dma_siz *dst, u16_t led);
+static void PWM_FillRGBW(volatile dma_siz *dst, u16_t led);
+/// Encoder for current layout, chosen once per frame
+static void (*PWM_FillLED)(volatile dma_siz *dst, u16_t led) = PWM_FillRGB;
+static void PWM_Next(volatile dma_siz *half);
+static HAL_StatusTypeDef ARGB_StartFrame(void);
+static HAL_StatusTypeDef ARGB_DMA_Restart(volatile dma_siz *src, u16_t len, bool frame);
 // Callbacks
 static void ARGB_TIM_DMADelayPulseCplt(DMA_HandleTypeDef *hdma);
 static void ARGB_TIM_DMADelayPulseHalfCplt(DMA_HandleTypeDef *hdma);
+static void ARGB_TIM_DMAResetCplt(DMA_HandleTypeDef *hdma);
 /// @} //Private
 
 /**
- * @brief Init timer & prescalers
+ * @brief Init timer & prescalers with settings from ARGB.h
  * @param none
+ * @return #ARGB_STATE enum, see ARGB_InitCfg().
+ * ARGB_PARAM_ERR if family's timings don't fit timer's clock or DMA width,
+ * driver stays uninitialized then
+ */
+ARGB_STATE ARGB_Init(void) {
+    return ARGB_InitCfg(&ARGB_DEF_CFG);
+}
+
+/**
+ * @brief Init timer & prescalers with runtime settings
+ * @param[in] cfg Strip's settings, see #ARGB_CONFIG
+ * @return #ARGB_STATE enum: ARGB_OK, ARGB_BUSY if transfer is in progress,
+ * ARGB_PARAM_ERR if settings are wrong or strip doesn't fit LED buffer
+ * @note LED buffer is cleared
  */
-void ARGB_Init(void) {
+ARGB_STATE ARGB_InitCfg(const ARGB_CONFIG *cfg) {
+    if (cfg == NULL || cfg->order > ARGB_GRBW) return ARGB_PARAM_ERR;
+    const u8_t bytes = (cfg->order >= ARGB_RGBW) ? 4 : 3;
+    if (cfg->pixels == 0 || cfg->pixels > NUM_PIXELS)
+        return ARGB_PARAM_ERR; // doesn't fit
+    if (cfg->t0h == 0 || cfg->t0h >= cfg->t1h || cfg->t1h >= cfg->period || cfg->reset == 0)
+        return ARGB_PARAM_ERR; // wrong timings
+    if (BUF_COUNTER != 0) return ARGB_BUSY; // don't change layout on air
+
     /* Auto-calculation! */
     u32_t APBfq; // Clock freq
 #ifdef APB1
@@ -139,26 +255,47 @@ void ARGB_Init(void) {
     APBfq = HAL_RCC_GetPCLK2Freq();
     APBfq *= (RCC->CFGR & RCC_CFGR_PPRE2) == 0 ? 1 : 2;
 #endif
-#ifdef WS2811S
-    APBfq /= (uint32_t) (400 * 1000);  // 400 KHz - 2.5us
-#else
-    APBfq /= (uint32_t) (800 * 1000);  // 800 KHz - 1.25us
+    u32_t RESfq = (u32_t) ((uint64_t) APBfq * cfg->reset / 1000000); // Reset length in timer ticks
+    APBfq = (u32_t) ((uint64_t) APBfq * cfg->period / 1000000000); // 1.25us - 800 KHz, 2.5us - 400 KHz
+    u32_t ARRmax = 0xFFFF; // 16-bit timer limit
+#ifdef IS_TIM_32B_COUNTER_INSTANCE
+    if (IS_TIM_32B_COUNTER_INSTANCE(TIM_HANDLE.Instance))
+        ARRmax = 0xFFFFFFFF;
 #endif
+    const u32_t HIfq = APBfq * cfg->t1h / cfg->period - 1; // Log.1 HI time in ticks
+    const u32_t LOfq = APBfq * cfg->t0h / cfg->period - 1; // Log.0 HI time in ticks
+    // check ticks, not ns: 1 <= LO < HI <= ARR, and HI fits DMA width
+    if (APBfq < 2 || APBfq - 1 > ARRmax || LOfq == 0 || LOfq >= HIfq
+        || HIfq > APBfq - 1 || (dma_siz) HIfq != HIfq || RESfq <= 2 * APBfq)
+        return ARGB_PARAM_ERR; // timings don't fit timer's clock, or reset is shorter than 2 bits
+
+    ARGB_PIXELS = cfg->pixels;
+    LED_BYTES = bytes;
+    PWM_LED_LEN = bytes * 8 * NUM_STRIPS;
+    ORD_POS = ORDER_POS[cfg->order];
+    memset((u8_t *) RGB_MEM, 0, sizeof(RGB_MEM));
+
+    ARR_BIT = APBfq - 1;
+    // one more zero bit always follows reset periods
+    u32_t RESlen = RESfq - APBfq;
+    // too long reset is split into equal periods, rounded up
+    RES_PERIODS = (u16_t) ((RESlen - 1) / ARRmax + 1);
+    ARR_RES = (RESlen + RES_PERIODS - 1) / RES_PERIODS - 1;
     TIM_HANDLE.Instance->PSC = 0;                        // dummy hardcode now
-    TIM_HANDLE.Instance->ARR = (uint16_t) (APBfq - 1);   // set timer prescaler
-    TIM_HANDLE.Instance->EGR = 1;                        // update timer registers
-#if defined(WS2811F) || defined(WS2811S)
-    PWM_HI = (u8_t) (APBfq * 0.48) - 1;     // Log.1 - 48% - 0.60us/1.2us
-    PWM_LO = (u8_t) (APBfq * 0.20) - 1;     // Log.0 - 20% - 0.25us/0.5us
-#endif
-#ifdef WS2812
-    PWM_HI = (u8_t) (APBfq * 0.56) - 1;     // Log.1 - 56% - 0.70us
-    PWM_LO = (u8_t) (APBfq * 0.28) - 1;     // Log.0 - 28% - 0.35us
-#endif
-#ifdef SK6812
-    PWM_HI = (u8_t) (APBfq * 0.48) - 1;     // Log.1 - 48% - 0.60us
-    PWM_LO = (u8_t) (APBfq * 0.24) - 1;     // Log.0 - 24% - 0.30us
+    TIM_HANDLE.Instance->ARR = (uint16_t) ARR_BIT;       // set timer prescaler
+    TIM_HANDLE.Instance->CR1 |= TIM_CR1_ARPE;            // ARR changes apply from next period
+#if TIM_BURST
+    TIM_HANDLE.Instance->CCR1 = 0;                       // keep lines low till first bit
+    TIM_HANDLE.Instance->CCR2 = 0;
+    TIM_HANDLE.Instance->CCR3 = 0;
+    TIM_HANDLE.Instance->CCR4 = 0;
+    TIM_HANDLE.Instance->DCR = TIM_DMABASE_CCR1 | TIM_DMABURSTLENGTH_4TRANSFERS; // DMAR -> CCR1..CCR4
+#else
+    TIM_HANDLE.Instance->ARGB_TIM_CCR = 0;               // keep line low till first bit
 #endif
+    TIM_HANDLE.Instance->EGR = 1;                        // update timer registers
+    PWM_HI = (dma_siz) HIfq;  // Log.1 HI time
+    PWM_LO = (dma_siz) LOfq;  // Log.0 HI time
 
 //#if INV_SIGNAL
 //    TIM_POINTER->CCER |= TIM_CCER_CC2P; // set inv ch bit
@@ -166,8 +303,17 @@ void ARGB_Init(void) {
 //    TIM_POINTER->CCER &= ~TIM_CCER_CC2P;
 //#endif
     ARGB_LOC_ST = ARGB_READY; // Set Ready Flag
+    ARGB_NEXT = false;
+#if TIM_BURST
+    TIM_CCxChannelCmd(TIM_HANDLE.Instance, TIM_CHANNEL_1, TIM_CCx_ENABLE); // Enable GPIOs to IDLE state
+    TIM_CCxChannelCmd(TIM_HANDLE.Instance, TIM_CHANNEL_2, TIM_CCx_ENABLE);
+    TIM_CCxChannelCmd(TIM_HANDLE.Instance, TIM_CHANNEL_3, TIM_CCx_ENABLE);
+    TIM_CCxChannelCmd(TIM_HANDLE.Instance, TIM_CHANNEL_4, TIM_CCx_ENABLE);
+#else
     TIM_CCxChannelCmd(TIM_HANDLE.Instance, TIM_CH, TIM_CCx_ENABLE); // Enable GPIO to IDLE state
+#endif
     HAL_Delay(1); // Make some delay
+    return ARGB_OK;
 }
 
 /**
@@ -177,9 +323,8 @@ void ARGB_Init(void) {
  */
 void ARGB_Clear(void) {
     ARGB_FillRGB(0, 0, 0);
-#ifdef SK6812
-    ARGB_FillWhite(0);
-#endif
+    if (LED_BYTES == 4)
+        ARGB_FillWhite(0);
 }
 
 /**
@@ -192,16 +337,16 @@ void ARGB_SetBrightness(u8_t br) {
 
 /**
  * @brief Set LED with RGB color by index
- * @param[in] i LED position
+ * @param[in] i LED position, strip N starts from N * pixels in burst mode
  * @param[in] r Red component   [0..255]
  * @param[in] g Green component [0..255]
  * @param[in] b Blue component  [0..255]
  */
 void ARGB_SetRGB(u16_t i, u8_t r, u8_t g, u8_t b) {
     // overflow protection
-    if (i >= NUM_PIXELS) {
-        u16_t _i = i / NUM_PIXELS;
-        i -= _i * NUM_PIXELS;
+    if (i >= NUM_LEDS) {
+        u16_t _i = i / NUM_LEDS;
+        i -= _i * NUM_LEDS;
     }
     // set brightness
     r /= 256 / ((u16_t) ARGB_BR + 1);
@@ -212,25 +357,10 @@ void ARGB_SetRGB(u16_t i, u8_t r, u8_t g, u8_t b) {
     b = scale8(b, 0xF0);
 #endif
     // Subpixel chain order
-#if defined(SK6812) || defined(WS2811F) || defined(WS2811S)
-    const u8_t subp1 = r;
-    const u8_t subp2 = g;
-    const u8_t subp3 = b;
-#else
-    const u8_t subp1 = g;
-    const u8_t subp2 = r;
-    const u8_t subp3 = b;
-#endif
-    // RGB or RGBW
-#ifdef SK6812
-    RGB_BUF[4 * i] = subp1;     // subpixel 1
-    RGB_BUF[4 * i + 1] = subp2; // subpixel 2
-    RGB_BUF[4 * i + 2] = subp3; // subpixel 3
-#else
-    RGB_BUF[3 * i] = subp1;     // subpixel 1
-    RGB_BUF[3 * i + 1] = subp2; // subpixel 2
-    RGB_BUF[3 * i + 2] = subp3; // subpixel 3
-#endif
+    volatile u8_t *pack = &RGB_BUF[LED_BYTES * i];
+    pack[ORD_POS[0]] = r;
+    pack[ORD_POS[1]] = g;
+    pack[ORD_POS[2]] = b;
 }
 
 /**
@@ -252,11 +382,9 @@ void ARGB_SetHSV(u16_t i, u8_t hue, u8_t sat, u8_t val) {
  * @param[in] w White component [0..255]
  */
 void ARGB_SetWhite(u16_t i, u8_t w) {
-#ifdef RGB
-    return;
-#endif
+    if (LED_BYTES != 4) return; // RGB only
     w /= 256 / ((u16_t) ARGB_BR + 1); // set brightness
-    RGB_BUF[4 * i + 3] = w;                // set white part
+    RGB_BUF[4 * i + ORD_POS[3]] = w;       // set white part
 }
 
 /**
@@ -266,7 +394,7 @@ void ARGB_SetWhite(u16_t i, u8_t w) {
  * @param[in] b Blue component  [0..255]
  */
 void ARGB_FillRGB(u8_t r, u8_t g, u8_t b) {
-    for (volatile u16_t i = 0; i < NUM_PIXELS; i++)
+    for (volatile u16_t i = 0; i < NUM_LEDS; i++)
         ARGB_SetRGB(i, r, g, b);
 }
 
@@ -287,93 +415,65 @@ void ARGB_FillHSV(u8_t hue, u8_t sat, u8_t val) {
  * @param[in] w White component [0..255]
  */
 void ARGB_FillWhite(u8_t w) {
-    for (volatile u16_t i = 0; i < NUM_PIXELS; i++)
+    for (volatile u16_t i = 0; i < NUM_LEDS; i++)
         ARGB_SetWhite(i, w);
 }
 
 /**
  * @brief Get current DMA status
  * @param none
- * @return #ARGB_STATE enum
+ * @return #ARGB_STATE enum: ARGB_READY if ARGB_Show() will take next frame
  */
 ARGB_STATE ARGB_Ready(void) {
-    return ARGB_LOC_ST;
+    if (ARGB_LOC_ST == ARGB_READY) return ARGB_READY;
+    // on-air buffer is encoded till the end, so next frame can be queued
+    return (!ARGB_NEXT && BUF_COUNTER >= ARGB_PIXELS) ? ARGB_READY : ARGB_BUSY;
 }
 
 /**
  * @brief Update strip
  * @param none
  * @return #ARGB_STATE enum
+ * @note Frame is taken with ARGB_OK, and LED buffer may be written again right after it.
+ * If previous frame is on air, new one is queued and starts right after the reset.
+ * It can be queued once previous frame's last LED is encoded, see ARGB_Ready().
  */
 ARGB_STATE ARGB_Show(void) {
-    ARGB_LOC_ST = ARGB_BUSY;
-    if (BUF_COUNTER != 0 || DMA_HANDLE.State != HAL_DMA_STATE_READY) {
+    u32_t primask = __get_PRIMASK();
+    __disable_irq(); // don't race with DMA callbacks
+    const bool idle = (ARGB_LOC_ST == ARGB_READY);
+    if (!idle && (ARGB_NEXT || BUF_COUNTER < ARGB_PIXELS)) {
+        __set_PRIMASK(primask);
+        return ARGB_BUSY; // on-air buffer is still in use
+    }
+    volatile u8_t *buf = RGB_TX; // swap buffers
+    RGB_TX = RGB_BUF;
+    RGB_BUF = buf;
+    if (idle)
+        ARGB_LOC_ST = ARGB_BUSY;
+    else
+        ARGB_NEXT = true; // queue next frame
+    __set_PRIMASK(primask);
+    // keep drawing on top of the frame sent
+    memcpy((u8_t *) RGB_BUF, (u8_t *) RGB_TX, NUM_LEDS * LED_BYTES);
+    if (!idle) return ARGB_OK;
+
+    ARGB_CH_STATE_SET(HAL_TIM_CHANNEL_STATE_BUSY);
+    if (ARGB_StartFrame() != HAL_OK) {
+        ARGB_CH_STATE_SET(HAL_TIM_CHANNEL_STATE_READY);
+        ARGB_LOC_ST = ARGB_READY;
         return ARGB_BUSY;
-    } else {
-        for (volatile u8_t i = 0; i < 8; i++) {
-            // set first transfer from first values
-            PWM_BUF[i] = (((RGB_BUF[0] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-            PWM_BUF[i + 8] = (((RGB_BUF[1] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-            PWM_BUF[i + 16] = (((RGB_BUF[2] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-            PWM_BUF[i + 24] = (((RGB_BUF[3] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-            PWM_BUF[i + 32] = (((RGB_BUF[4] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-            PWM_BUF[i + 40] = (((RGB_BUF[5] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-#ifdef SK6812
-            PWM_BUF[i + 48] = (((RGB_BUF[6] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-            PWM_BUF[i + 56] = (((RGB_BUF[7] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-#endif
-        }
-        HAL_StatusTypeDef DMA_Send_Stat = HAL_ERROR;
-        while (DMA_Send_Stat != HAL_OK) {
-            if (TIM_CHANNEL_STATE_GET(&TIM_HANDLE, TIM_CH) == HAL_TIM_CHANNEL_STATE_BUSY) {
-                DMA_Send_Stat = HAL_BUSY;
-                continue;
-            } else if (TIM_CHANNEL_STATE_GET(&TIM_HANDLE, TIM_CH) == HAL_TIM_CHANNEL_STATE_READY) {
-                TIM_CHANNEL_STATE_SET(&TIM_HANDLE, TIM_CH, HAL_TIM_CHANNEL_STATE_BUSY);
-            } else {
-                DMA_Send_Stat = HAL_ERROR;
-                continue;
-            }
-#if TIM_CH == TIM_CHANNEL_1
-#define ARGB_TIM_DMA_ID TIM_DMA_ID_CC1
-#define ARGB_TIM_DMA_CC TIM_DMA_CC1
-#define ARGB_TIM_CCR CCR1
-#elif TIM_CH == TIM_CHANNEL_2
-#define ARGB_TIM_DMA_ID TIM_DMA_ID_CC2
-#define ARGB_TIM_DMA_CC TIM_DMA_CC2
-#define ARGB_TIM_CCR CCR2
-#elif TIM_CH == TIM_CHANNEL_3
-#define ARGB_TIM_DMA_ID TIM_DMA_ID_CC3
-#define ARGB_TIM_DMA_CC TIM_DMA_CC3
-#define ARGB_TIM_CCR CCR3
-#elif TIM_CH == TIM_CHANNEL_4
-#define ARGB_TIM_DMA_ID TIM_DMA_ID_CC4
-#define ARGB_TIM_DMA_CC TIM_DMA_CC4
-#define ARGB_TIM_CCR CCR4
-#endif
-            TIM_HANDLE.hdma[ARGB_TIM_DMA_ID]->XferCpltCallback = ARGB_TIM_DMADelayPulseCplt;
-            TIM_HANDLE.hdma[ARGB_TIM_DMA_ID]->XferHalfCpltCallback = ARGB_TIM_DMADelayPulseHalfCplt;
-            TIM_HANDLE.hdma[ARGB_TIM_DMA_ID]->XferErrorCallback = TIM_DMAError;
-            if (HAL_DMA_Start_IT(TIM_HANDLE.hdma[ARGB_TIM_DMA_ID], (u32_t) PWM_BUF,
-                                 (u32_t) &TIM_HANDLE.Instance->ARGB_TIM_CCR,
-                                 (u16_t) PWM_BUF_LEN) != HAL_OK) {
-                DMA_Send_Stat = HAL_ERROR;
-                continue;
-            }
-            __HAL_TIM_ENABLE_DMA(&TIM_HANDLE, ARGB_TIM_DMA_CC);
-            if (IS_TIM_BREAK_INSTANCE(TIM_HANDLE.Instance) != RESET)
-                __HAL_TIM_MOE_ENABLE(&TIM_HANDLE);
-            if (IS_TIM_SLAVE_INSTANCE(TIM_HANDLE.Instance)) {
-                u32_t tmpsmcr = TIM_HANDLE.Instance->SMCR & TIM_SMCR_SMS;
-                if (!IS_TIM_SLAVEMODE_TRIGGER_ENABLED(tmpsmcr))
-                    __HAL_TIM_ENABLE(&TIM_HANDLE);
-            } else
-                __HAL_TIM_ENABLE(&TIM_HANDLE);
-            DMA_Send_Stat = HAL_OK;
-        }
-        BUF_COUNTER = 2;
-        return ARGB_OK;
     }
+    // Timer keeps running between frames, so it's enabled only once
+    if (IS_TIM_BREAK_INSTANCE(TIM_HANDLE.Instance) != RESET)
+        __HAL_TIM_MOE_ENABLE(&TIM_HANDLE);
+    if (IS_TIM_SLAVE_INSTANCE(TIM_HANDLE.Instance)) {
+        u32_t tmpsmcr = TIM_HANDLE.Instance->SMCR & TIM_SMCR_SMS;
+        if (!IS_TIM_SLAVEMODE_TRIGGER_ENABLED(tmpsmcr))
+            __HAL_TIM_ENABLE(&TIM_HANDLE);
+    } else
+        __HAL_TIM_ENABLE(&TIM_HANDLE);
+    return ARGB_OK;
 }
 
 /**
@@ -390,6 +490,109 @@ static inline u8_t scale8(u8_t x, u8_t scale) {
     return ((uint16_t) x * scale) >> 8;
 }
 
+/**
+ * @brief Convert one LED of every strip into PWM values
+ * @param[out] dst Destination in PWM buffer
+ * @param[in] led LED position in strip
+ * @param[in] bytes Pack len, constant in layout's encoder
+ * @note In burst mode strips are interleaved: CCR1..CCR4 for each bit
+ */
+static inline void PWM_FillPack(volatile dma_siz *dst, u16_t led, const u8_t bytes) {
+    const dma_siz hi = PWM_HI, lo = PWM_LO;
+    const u16_t stride = bytes * ARGB_PIXELS; // strip size in bytes
+    for (u8_t s = 0; s < NUM_STRIPS; s++) {
+        const volatile u8_t *src = &RGB_TX[s * stride + bytes * led];
+        for (u8_t b = 0; b < bytes; b++) {
+            const u8_t byte = src[b];
+            for (u8_t i = 0; i < 8; i++)
+                dst[(b * 8 + i) * NUM_STRIPS + s] = (((byte << i) & 0x80) > 0) ? hi : lo;
+        }
+    }
+}
+
+/**
+ * @brief RGB layout encoder
+ * @param[out] dst Destination in PWM buffer
+ * @param[in] led LED position in strip
+ */
+static void PWM_FillRGB(volatile dma_siz *dst, u16_t led) {
+    PWM_FillPack(dst, led, 3);
+}
+
+/**
+ * @brief RGBW layout encoder
+ * @param[out] dst Destination in PWM buffer
+ * @param[in] led LED position in strip
+ */
+static void PWM_FillRGBW(volatile dma_siz *dst, u16_t led) {
+    PWM_FillPack(dst, led, 4);
+}
+
+/**
+ * @brief Refill sent half of PWM buffer, or go to reset after the last LED
+ * @param[in] half Sent half of PWM buffer
+ */
+static void PWM_Next(volatile dma_siz *half) {
+    if (BUF_COUNTER < ARGB_PIXELS) { // if data transfer
+        PWM_FillLED(half, BUF_COUNTER);
+        BUF_COUNTER++;
+    } else if (BUF_COUNTER == ARGB_PIXELS) { // last LED is on air
+        memset((dma_siz *) half, 0, PWM_LED_LEN * sizeof(dma_siz));
+        BUF_COUNTER++;
+    } else { // last LED sent - hand reset to the timer
+        (void) ARGB_DMA_Restart(PWM_ZERO, NUM_STRIPS, false);
+        BUF_COUNTER++;
+    }
+}
+
+/**
+ * @brief Fill PWM buffer with first LEDs and start frame transfer
+ * @param none
+ * @return HAL status of DMA start
+ */
+static HAL_StatusTypeDef ARGB_StartFrame(void) {
+    PWM_FillLED = (LED_BYTES == 4) ? PWM_FillRGBW : PWM_FillRGB; // layout is fixed for the frame
+    // set first transfer from first values
+    PWM_FillLED(&PWM_BUF[0], 0);
+    if (ARGB_PIXELS > 1)
+        PWM_FillLED(&PWM_BUF[PWM_LED_LEN], 1);
+    else // single LED - second part is already reset
+        memset((dma_siz *) &PWM_BUF[PWM_LED_LEN], 0, PWM_LED_LEN * sizeof(dma_siz));
+    BUF_COUNTER = 2;
+    if (ARGB_DMA_Restart(PWM_BUF, 2 * PWM_LED_LEN, true) != HAL_OK) {
+        BUF_COUNTER = 0;
+        return HAL_ERROR;
+    }
+    return HAL_OK;
+}
+
+/**
+ * @brief Switch timer's DMA stream to another source
+ * @param[in] src Source buffer
+ * @param[in] len Source length
+ * @param[in] frame true - circular frame buffer with half refill,
+ * false - reset stream with single IRQ on each transfer
+ * @return HAL status of DMA start
+ */
+static HAL_StatusTypeDef ARGB_DMA_Restart(volatile dma_siz *src, u16_t len, bool frame) {
+    DMA_HandleTypeDef *hdma = TIM_HANDLE.hdma[ARGB_TIM_DMA_ID];
+    __HAL_TIM_DISABLE_DMA(&TIM_HANDLE, ARGB_TIM_DMA_CC);
+    if (hdma->State == HAL_DMA_STATE_BUSY)
+        (void) HAL_DMA_Abort(hdma); // also drops pending flags
+    if (frame) {
+        hdma->XferCpltCallback = ARGB_TIM_DMADelayPulseCplt;
+        hdma->XferHalfCpltCallback = ARGB_TIM_DMADelayPulseHalfCplt;
+    } else {
+        hdma->XferCpltCallback = ARGB_TIM_DMAResetCplt;
+        hdma->XferHalfCpltCallback = NULL; // HT IRQ stays disabled
+    }
+    hdma->XferErrorCallback = TIM_DMAError;
+    if (HAL_DMA_Start_IT(hdma, (u32_t) src, (u32_t) &TIM_HANDLE.Instance->ARGB_TIM_CCR, len) != HAL_OK)
+        return HAL_ERROR;
+    __HAL_TIM_ENABLE_DMA(&TIM_HANDLE, ARGB_TIM_DMA_CC);
+    return HAL_OK;
+}
+
 /**
  * @brief Convert color in HSV to RGB
  * @param[in] hue HUE (color) [0..255]
@@ -445,78 +648,7 @@ static void ARGB_TIM_DMADelayPulseCplt(DMA_HandleTypeDef *hdma) {
     // if wrong handlers
     if (hdma != &DMA_HANDLE || htim != &TIM_HANDLE) return;
     if (BUF_COUNTER == 0) return; // if no data to transmit - return
-    if (hdma == htim->hdma[TIM_DMA_ID_CC1]) {
-        htim->Channel = HAL_TIM_ACTIVE_CHANNEL_1;
-        if (hdma->Init.Mode == DMA_NORMAL) {
-            TIM_CHANNEL_STATE_SET(htim, TIM_CHANNEL_1, HAL_TIM_CHANNEL_STATE_READY);
-        }
-    } else if (hdma == htim->hdma[TIM_DMA_ID_CC2]) {
-        htim->Channel = HAL_TIM_ACTIVE_CHANNEL_2;
-        if (hdma->Init.Mode == DMA_NORMAL) {
-            TIM_CHANNEL_STATE_SET(htim, TIM_CHANNEL_2, HAL_TIM_CHANNEL_STATE_READY);
-        }
-    } else if (hdma == htim->hdma[TIM_DMA_ID_CC3]) {
-        htim->Channel = HAL_TIM_ACTIVE_CHANNEL_3;
-        if (hdma->Init.Mode == DMA_NORMAL) {
-            TIM_CHANNEL_STATE_SET(htim, TIM_CHANNEL_3, HAL_TIM_CHANNEL_STATE_READY);
-        }
-    } else if (hdma == htim->hdma[TIM_DMA_ID_CC4]) {
-        htim->Channel = HAL_TIM_ACTIVE_CHANNEL_4;
-        if (hdma->Init.Mode == DMA_NORMAL) {
-            TIM_CHANNEL_STATE_SET(htim, TIM_CHANNEL_4, HAL_TIM_CHANNEL_STATE_READY);
-        }
-    } else {
-        /* nothing to do */
-    }
-// if data transfer
-    if (BUF_COUNTER < NUM_PIXELS) {
-        // fill second part of buffer
-        for (volatile u8_t i = 0; i < 8; i++) {
-#ifdef SK6812
-            PWM_BUF[i + 32] = (((RGB_BUF[4 * BUF_COUNTER] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-            PWM_BUF[i + 40] = (((RGB_BUF[4 * BUF_COUNTER + 1] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-            PWM_BUF[i + 48] = (((RGB_BUF[4 * BUF_COUNTER + 2] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-            PWM_BUF[i + 56] = (((RGB_BUF[4 * BUF_COUNTER + 3] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-#else
-            PWM_BUF[i + 24] = (((RGB_BUF[3 * BUF_COUNTER] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-            PWM_BUF[i + 32] = (((RGB_BUF[3 * BUF_COUNTER + 1] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-            PWM_BUF[i + 40] = (((RGB_BUF[3 * BUF_COUNTER + 2] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-#endif
-        }
-        BUF_COUNTER++;
-    } else if (BUF_COUNTER < NUM_PIXELS + 2) { // if RET transfer
-        memset((dma_siz *) &PWM_BUF[PWM_BUF_LEN / 2], 0, (PWM_BUF_LEN / 2)*sizeof(dma_siz)); // second part
-        BUF_COUNTER++;
-    } else { // if END of transfer
-        BUF_COUNTER = 0;
-        // STOP DMA:
-#if TIM_CH == TIM_CHANNEL_1
-        __HAL_TIM_DISABLE_DMA(htim, TIM_DMA_CC1);
-        (void) HAL_DMA_Abort_IT(htim->hdma[TIM_DMA_ID_CC1]);
-#endif
-#if TIM_CH == TIM_CHANNEL_2
-        __HAL_TIM_DISABLE_DMA(htim, TIM_DMA_CC2);
-        (void) HAL_DMA_Abort_IT(htim->hdma[TIM_DMA_ID_CC2]);
-#endif
-#if TIM_CH == TIM_CHANNEL_3
-        __HAL_TIM_DISABLE_DMA(htim, TIM_DMA_CC3);
-        (void) HAL_DMA_Abort_IT(htim->hdma[TIM_DMA_ID_CC3]);
-#endif
-#if TIM_CH == TIM_CHANNEL_4
-        __HAL_TIM_DISABLE_DMA(htim, TIM_DMA_CC4);
-        (void) HAL_DMA_Abort_IT(htim->hdma[TIM_DMA_ID_CC4]);
-#endif
-        if (IS_TIM_BREAK_INSTANCE(htim->Instance) != RESET) {
-            /* Disable the Main Output */
-            __HAL_TIM_MOE_DISABLE(htim);
-        }
-        /* Disable the Peripheral */
-        __HAL_TIM_DISABLE(htim);
-        /* Set the TIM channel state */
-        TIM_CHANNEL_STATE_SET(htim, TIM_CH, HAL_TIM_CHANNEL_STATE_READY);
-        ARGB_LOC_ST = ARGB_READY;
-    }
-    htim->Channel = HAL_TIM_ACTIVE_CHANNEL_CLEARED;
+    PWM_Next(&PWM_BUF[PWM_LED_LEN]); // second part
 }
 
 /**
@@ -529,26 +661,47 @@ static void ARGB_TIM_DMADelayPulseHalfCplt(DMA_HandleTypeDef *hdma) {
     // if wrong handlers
     if (hdma != &DMA_HANDLE || htim != &TIM_HANDLE) return;
     if (BUF_COUNTER == 0) return; // if no data to transmit - return
-    // if data transfer
-    if (BUF_COUNTER < NUM_PIXELS) {
-        // fill first part of buffer
-        for (volatile u8_t i = 0; i < 8; i++) {
-#ifdef SK6812
-            PWM_BUF[i] = (((RGB_BUF[4 * BUF_COUNTER] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-            PWM_BUF[i + 8] = (((RGB_BUF[4 * BUF_COUNTER + 1] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-            PWM_BUF[i + 16] = (((RGB_BUF[4 * BUF_COUNTER + 2] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-            PWM_BUF[i + 24] = (((RGB_BUF[4 * BUF_COUNTER + 3] << i) & 0x80) > 0)? PWM_HI : PWM_LO;
-#else
-            PWM_BUF[i] = (((RGB_BUF[3 * BUF_COUNTER] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-            PWM_BUF[i + 8] = (((RGB_BUF[3 * BUF_COUNTER + 1] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-            PWM_BUF[i + 16] = (((RGB_BUF[3 * BUF_COUNTER + 2] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-#endif
-        }
+    PWM_Next(&PWM_BUF[0]); // first part
+}
+
+/**
+  * @brief  TIM DMA reset stream complete callback.
+  * @param  hdma pointer to DMA handle.
+  * @retval None
+  * @note Reset is a stretched timer period with zero pulse (few of them,
+  * if it doesn't fit 16-bit timer), so it takes 1 + RES_PERIODS IRQs:
+  * 1) zero is latched into CCR - stretch next period;
+  * 2) stretched period started - on the last one restore period,
+  * start queued frame or go idle.
+  * Stream is restarted after ARR write, so the 2nd IRQ always comes
+  * at the start of the stretched period, even if the 1st one was late.
+  */
+static void ARGB_TIM_DMAResetCplt(DMA_HandleTypeDef *hdma) {
+    TIM_HandleTypeDef *htim = (TIM_HandleTypeDef *) ((DMA_HandleTypeDef *) hdma)->Parent;
+    // if wrong handlers
+    if (hdma != &DMA_HANDLE || htim != &TIM_HANDLE) return;
+    if (BUF_COUNTER == 0) return; // if no data to transmit - return
+    if (BUF_COUNTER == ARGB_PIXELS + 2) { // line is low
+        htim->Instance->ARR = ARR_RES; // preloaded, applies from next period
+        (void) ARGB_DMA_Restart(PWM_ZERO, NUM_STRIPS, false);
         BUF_COUNTER++;
-    } else if (BUF_COUNTER < NUM_PIXELS + 2) { // if RET transfer
-        memset((dma_siz *) &PWM_BUF[0], 0, (PWM_BUF_LEN / 2)*sizeof(dma_siz)); // first part
+        return;
+    }
+    if (BUF_COUNTER < ARGB_PIXELS + 2 + RES_PERIODS) { // not the last stretched period
         BUF_COUNTER++;
+        return;
+    }
+    htim->Instance->ARR = ARR_BIT; // back to bit period after reset
+    if (ARGB_NEXT) { // start queued frame, it'll go on air right after reset
+        ARGB_NEXT = false;
+        if (ARGB_StartFrame() == HAL_OK) return;
     }
+    // go idle: timer keeps running with zero pulse, DMA is stopped
+    __HAL_TIM_DISABLE_DMA(htim, ARGB_TIM_DMA_CC);
+    (void) HAL_DMA_Abort(hdma);
+    BUF_COUNTER = 0;
+    ARGB_CH_STATE_SET(HAL_TIM_CHANNEL_STATE_READY);
+    ARGB_LOC_ST = ARGB_READY;
 }
 
 /** @} */ // Private
@@ -556,18 +709,18 @@ static void ARGB_TIM_DMADelayPulseHalfCplt(DMA_HandleTypeDef *hdma) {
 /** @} */ // Driver
 
 // Check strip type
-#if !(defined(SK6812) || defined(WS2811F) || defined(WS2811S) || defined(WS2812))
+#if !(defined(SK6812) || defined(WS2811F) || defined(WS2811S) || defined(WS2812) || defined(WS2812B))
 #error INCORRECT LED TYPE
-#warning Set it from list in ARGB.h string 29
+#warning Set LED family from list in ARGB.h
 #endif
 
 // Check channel
-#if !(TIM_CH == TIM_CHANNEL_1 || TIM_CH == TIM_CHANNEL_2 || TIM_CH == TIM_CHANNEL_3 || TIM_CH == TIM_CHANNEL_4)
-#error Wrong channel! Fix it in ARGB.h string 40
+#if !TIM_BURST && !(TIM_CH == TIM_CHANNEL_1 || TIM_CH == TIM_CHANNEL_2 || TIM_CH == TIM_CHANNEL_3 || TIM_CH == TIM_CHANNEL_4)
+#error Wrong channel! Fix TIM_CH in ARGB.h
 #warning If you shure, search and set TIM_CHANNEL by yourself
 #endif
 
 // Check DMA Size
 #if !(defined(DMA_SIZE_BYTE) | defined(DMA_SIZE_HWORD) | defined(DMA_SIZE_WORD))
-#error Wrong DMA Size! Fix it in ARGB.h string 42
+#error Wrong DMA Size! Fix DMA_SIZE_* in ARGB.h
 #endif
@@ -26,13 +26,16 @@
  * @{
  */
 
-#define WS2812       ///< Family: {WS2811S, WS2811F, WS2812, SK6812}
+#define WS2812       ///< Family: {WS2811S, WS2811F, WS2812, WS2812B, SK6812}
 // WS2811S — RGB, 400kHz;
 // WS2811F — RGB, 800kHz;
 // WS2812  — GRB, 800kHz;
+// WS2812B — GRB, 800kHz, 280us reset (V5);
 // SK6812  — RGBW, 800kHz
 
-#define NUM_PIXELS 5 ///< Pixel quantity
+//#define RESET_US 300 ///< Reset (latch) length in us, family's default if not set
+
+#define NUM_PIXELS 5 ///< Max pixels per strip
 
 #define USE_GAMMA_CORRECTION 1 ///< Gamma-correction should fix red&green, try for yourself
 
@@ -42,6 +45,10 @@
 #define DMA_SIZE_WORD     ///< DMA Memory Data Width: {.._BYTE, .._HWORD, .._WORD}
 // DMA channel can be found in main.c / tim.c
 
+#define TIM_BURST  0  ///< 1 - drive CH1..CH4 in parallel by timer's DMA burst, TIM_CH is ignored
+// In burst mode DMA_HANDLE is timer's UPDATE channel (e.g. hdma_tim2_up),
+// pixels are per strip and strip N starts from LED N * pixels set in ARGB_InitCfg (NUM_PIXELS by default)
+
 /// @}
 
 /**
@@ -58,7 +65,33 @@ typedef enum ARGB_STATE {
     ARGB_PARAM_ERR = 3, ///< Error in input parameters
 } ARGB_STATE;
 
-void ARGB_Init(void);   // Initialization
+/**
+ * @enum ARGB_ORDER
+ * @brief Subpixel order in LED's pack, W makes it 4 bytes
+ */
+typedef enum ARGB_ORDER {
+    ARGB_RGB = 0,  ///< WS2811
+    ARGB_GRB = 1,  ///< WS2812, WS2812B
+    ARGB_BRG = 2,  ///< Some WS2811 clones
+    ARGB_RGBW = 3, ///< SK6812
+    ARGB_GRBW = 4, ///< SK6812 clones
+} ARGB_ORDER;
+
+/**
+ * @struct ARGB_CONFIG
+ * @brief Strip's runtime settings for ARGB_InitCfg()
+ */
+typedef struct ARGB_CONFIG {
+    u16_t pixels;     ///< Pixel quantity per strip [1..NUM_PIXELS]
+    ARGB_ORDER order; ///< Subpixel order & pack size
+    u16_t period;     ///< Bit period, ns: 1250 - 800kHz, 2500 - 400kHz
+    u16_t t1h;        ///< Log.1 HI time, ns
+    u16_t t0h;        ///< Log.0 HI time, ns
+    u16_t reset;      ///< Reset (latch) length, us
+} ARGB_CONFIG;
+
+ARGB_STATE ARGB_Init(void);   // Initialization
+ARGB_STATE ARGB_InitCfg(const ARGB_CONFIG *cfg); // Initialization with runtime settings
 void ARGB_Clear(void);  // Clear strip
 
 void ARGB_SetBrightness(u8_t br); // Set global brightness
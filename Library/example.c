@@ -1,18 +1,21 @@
 #include "ARGB.h"
 
 void main(void){
-    ARGB_Init();  // Initialization
+    if (ARGB_Init() != ARGB_OK) return; // Initialization, fails if timings don't fit timer's clock
+    // or with runtime settings, e.g. 3 SK6812 LEDs:
+    // ARGB_CONFIG cfg = {.pixels = 3, .order = ARGB_RGBW, .period = 1250, .t1h = 600, .t0h = 300, .reset = 80};
+    // ARGB_InitCfg(&cfg);
 
     ARGB_Clear(); // Clear stirp
-    while (ARGB_Show() != ARGB_OK); // Update - Option 1
+    while (ARGB_Show() != ARGB_OK); // Update - Option 1 (started or queued, buffer is free again)
 
     ARGB_SetBrightness(100);  // Set global brightness to 40%
 
     ARGB_SetRGB(2, 0, 255, 0); // Set LED №3 with 255 Green
-    while (!ARGB_Show());  // Update - Option 2
+    while (!ARGB_Show());  // Update - Option 2 (same, ARGB_BUSY is 0)
 
     ARGB_SetHSV(0, 0, 255, 255); // Set LED №1 with Red
-    while (!ARGB_Ready()); // Update - Option 3
+    while (!ARGB_Ready()); // Update - Option 3 (wait till frame can be taken)
     ARGB_Show();
 
     ARGB_FillWhite(230); // Fill all white component with 230